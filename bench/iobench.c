@@ -0,0 +1,198 @@
+/*
+    Throughput benchmark of the ptuclib.h I/O runtime against the
+    printf/fgets based implementation it replaced.
+
+    Usage: ./bench/iobench [records]
+
+    Writes go to /dev/null, reads come from a temporary file; timings
+    are reported on stderr in millions of records per second.
+*/
+#include <fcntl.h>
+#include <time.h>
+#include "ptuclib.h"
+
+/* the original runtime, kept here as the baseline */
+#define legacy_writeString(x) printf("%s",(x))
+#define legacy_writeInteger(x) printf("%d",(x))
+#define legacy_writeReal(x) printf("%g",(x))
+
+#define BUFSIZE 1024
+
+char *
+legacy_readString() {
+    char buffer[BUFSIZE];
+    buffer[0] = '\0';
+    fgets(buffer, BUFSIZE, stdin);
+    /* strip newline from the end */
+    uint32_t blen = strlen(buffer);
+    if (blen > 0 && buffer[blen - 1] == '\n')
+        buffer[blen - 1] = '\0';
+    return strdup(buffer);
+}
+
+#undef BUFSIZE
+
+int
+legacy_readInteger() {
+    char *s = legacy_readString();
+    uint32_t val = (uint32_t) strtol(s, NULL, 10);
+    free(s);
+    return val;
+}
+
+double
+legacy_readReal() {
+    char *s = legacy_readString();
+    double val = strtod(s, NULL);
+    free(s);
+    return val;
+}
+
+/* wall clock in seconds */
+double
+now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* print one result row */
+void
+report(const char *what, long recs, double legacy, double fast) {
+    fprintf(stderr, "  %-16s %10.2f %10.2f %8.2fx\n", what,
+            recs / legacy / 1e6, recs / fast / 1e6, legacy / fast);
+}
+
+/* point both stdin and fd 0 at the start of `path` */
+void
+rewind_input(const char *path) {
+    if (freopen(path, "r", stdin) == NULL) {
+        perror("freopen");
+        exit(EXIT_FAILURE);
+    }
+    ptuc_in_reset();
+}
+
+int
+main(int argc, char **argv) {
+    long recs = argc > 1 ? strtol(argv[1], NULL, 10) : 5000000;
+    if (recs <= 0) {
+        fprintf(stderr, "Usage: %s [records]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (freopen("/dev/null", "w", stdout) == NULL) {
+        perror("freopen");
+        return EXIT_FAILURE;
+    }
+
+    double t0, legacy, fast;
+    volatile long sink = 0;
+    fprintf(stderr, "\n -- %ld records, Mrec/s (legacy, ptuclib, speedup)\n\n",
+            recs);
+
+    /* writeInteger */
+    t0 = now();
+    for (long i = 0; i < recs; i++) {
+        legacy_writeInteger((int) (i * 7919 - recs));
+        legacy_writeString("\n");
+    }
+    fflush(stdout);
+    legacy = now() - t0;
+    t0 = now();
+    for (long i = 0; i < recs; i++) {
+        writeInteger((int) (i * 7919 - recs));
+        writeString("\n");
+    }
+    flushOutput();
+    fast = now() - t0;
+    report("writeInteger", recs, legacy, fast);
+
+    /* writeReal, half integral values and half fractions */
+    t0 = now();
+    for (long i = 0; i < recs; i++) {
+        legacy_writeReal(i & 1 ? i * 0.25 : (double) i);
+        legacy_writeString("\n");
+    }
+    fflush(stdout);
+    legacy = now() - t0;
+    t0 = now();
+    for (long i = 0; i < recs; i++) {
+        writeReal(i & 1 ? i * 0.25 : (double) i);
+        writeString("\n");
+    }
+    flushOutput();
+    fast = now() - t0;
+    report("writeReal", recs, legacy, fast);
+
+    /* writeString */
+    t0 = now();
+    for (long i = 0; i < recs; i++) { legacy_writeString("hello world\n"); }
+    fflush(stdout);
+    legacy = now() - t0;
+    t0 = now();
+    for (long i = 0; i < recs; i++) { writeString("hello world\n"); }
+    flushOutput();
+    fast = now() - t0;
+    report("writeString", recs, legacy, fast);
+
+    /* input file for the readers: integers, reals and strings */
+    char path[] = "/tmp/ptuc_iobenchXXXXXX";
+    int fd = mkstemp(path);
+    FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (f == NULL) {
+        perror("mkstemp");
+        return EXIT_FAILURE;
+    }
+    for (long i = 0; i < recs; i++) { fprintf(f, "%ld\n", i * 7919 - recs); }
+    for (long i = 0; i < recs; i++) { fprintf(f, "%.3f\n", i * 0.125); }
+    for (long i = 0; i < recs; i++) { fprintf(f, "record number %ld\n", i); }
+    fclose(f);
+
+    rewind_input(path);
+    t0 = now();
+    for (long i = 0; i < recs; i++) { sink += legacy_readInteger(); }
+    legacy = now() - t0;
+    rewind_input(path);
+    t0 = now();
+    for (long i = 0; i < recs; i++) { sink += readInteger(); }
+    fast = now() - t0;
+    report("readInteger", recs, legacy, fast);
+
+    /* the reals follow the integers in the file */
+    rewind_input(path);
+    for (long i = 0; i < recs; i++) { free(legacy_readString()); }
+    t0 = now();
+    for (long i = 0; i < recs; i++) { sink += (long) legacy_readReal(); }
+    legacy = now() - t0;
+    rewind_input(path);
+    for (long i = 0; i < recs; i++) { readInteger(); }
+    t0 = now();
+    for (long i = 0; i < recs; i++) { sink += (long) readReal(); }
+    fast = now() - t0;
+    report("readReal", recs, legacy, fast);
+
+    /* and the strings follow the reals */
+    rewind_input(path);
+    for (long i = 0; i < 2 * recs; i++) { free(legacy_readString()); }
+    t0 = now();
+    for (long i = 0; i < recs; i++) {
+        char *s = legacy_readString();
+        sink += s[0];
+        free(s);
+    }
+    legacy = now() - t0;
+    rewind_input(path);
+    for (long i = 0; i < 2 * recs; i++) { readInteger(); }
+    t0 = now();
+    for (long i = 0; i < recs; i++) {
+        char *s = readString();
+        sink += s[0];
+        arrayRelease(s);
+    }
+    fast = now() - t0;
+    report("readString", recs, legacy, fast);
+
+    unlink(path);
+    fprintf(stderr, "\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+#!/usr/bin/env bash
+#
+# Runtime benchmarks for generated programs: builds every kernel in
+# bench/*.ptuc with each C compiler at each optimisation level through
+# `ptucc --build`, runs it several times and prints the median, mean,
+# spread and standard deviation of the wall clock times.
+#
+# The output of every build is compared against the first build of the
+# same kernel, so codegen changes that alter results show up as DIFF.
+#
+# Knobs (environment):
+#   CCS    C compilers to try            (default: "gcc clang")
+#   OPTS   optimisation levels            (default: "-O2 -O3")
+#   RUNS   timed runs per build           (default: 5)
+#   SCALE  multiplier for the input sizes (default: 1)
+#
+# Usage: bench/runbench.sh [kernel...]     (default: every bench/*.ptuc)
+
+set -u
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(dirname "$BENCH_DIR")
+PTUCC=${PTUCC:-$ROOT/ptucc}
+CCS=${CCS:-gcc clang}
+OPTS=${OPTS:--O2 -O3}
+RUNS=${RUNS:-5}
+SCALE=${SCALE:-1}
+OUT=$BENCH_DIR/out
+
+TIMEFORMAT=%3R
+
+if [ ! -x "$PTUCC" ]; then
+    echo " -- Error: $PTUCC not found, run make first" >&2
+    exit 1
+fi
+mkdir -p "$OUT"
+
+# write the input of kernel $1 to $2
+make_input() {
+    case $1 in
+        numeric)   echo $((20000000 * SCALE)) ;;
+        recursive) echo 38 ;;
+        strings)   echo $((15000000 * SCALE)) ;;
+        branches)  printf '100000\n%d\n' $((15 * SCALE)) ;;
+        funcptr)   echo $((200000000 * SCALE)) ;;
+        arrays)    echo $((3000000 * SCALE)) ;;
+        io)        awk -v n=$((4000000 * SCALE)) 'BEGIN {
+                       print n; srand(42)
+                       for (i = 0; i < n; i++) print int(rand() * 2000000) - 1000000 }' ;;
+        *)         echo 1000000 ;;
+    esac > "$2"
+}
+
+# median, mean, min-max, stddev of the numbers on stdin
+stats() {
+    sort -n | awk '{ t[NR] = $1; s += $1; ss += $1 * $1 }
+        END {
+            if (NR == 0) { exit 1 }
+            med = NR % 2 ? t[(NR + 1) / 2] : (t[NR / 2] + t[NR / 2 + 1]) / 2
+            mean = s / NR; var = ss / NR - mean * mean
+            printf "%8.3f %8.3f %8.3f-%-8.3f %7.4f", med, mean, t[1], t[NR], (var > 0 ? sqrt(var) : 0)
+        }'
+}
+
+if [ $# -gt 0 ]; then
+    kernels="$*"
+else
+    kernels=$(cd "$BENCH_DIR" && ls *.ptuc | sed 's/\.ptuc$//')
+fi
+
+printf "%-10s %-6s %-4s %8s %8s %17s %7s  %s\n" \
+    kernel cc opt median mean min-max stddev output
+for k in $kernels; do
+    src=$BENCH_DIR/$k.ptuc
+    if [ ! -r "$src" ]; then
+        echo " -- Error: no such kernel $src" >&2
+        continue
+    fi
+    make_input "$k" "$OUT/$k.in"
+    ref=
+    for cc in $CCS; do
+        for opt in $OPTS; do
+            row=$(printf "%-10s %-6s %-4s" "$k" "$cc" "$opt")
+            if ! command -v "$cc" > /dev/null 2>&1; then
+                printf "%s %8s\n" "$row" "n/a (not installed)"
+                continue
+            fi
+            prog=$OUT/$k-$cc$opt
+            if ! PTUCC_CC="$cc" "$PTUCC" --build -o "$prog" "$src" -w "$opt" \
+                    > "$OUT/$k-$cc$opt.log" 2>&1; then
+                printf "%s %8s\n" "$row" "n/a (build failed, see ${prog#$ROOT/}.log)"
+                continue
+            fi
+
+            # one untimed run to warm up and to check the output
+            "$prog" < "$OUT/$k.in" > "$prog.out"
+            sum=$(cksum < "$prog.out")
+            [ -z "$ref" ] && ref=$sum
+            if [ "$sum" = "$ref" ]; then check=ok; else check=DIFF; fi
+
+            times=$(for r in $(seq "$RUNS"); do
+                { time "$prog" < "$OUT/$k.in" > /dev/null; } 2>&1
+            done)
+            printf "%s %s  %s\n" "$row" "$(echo "$times" | stats)" "$check"
+        done
+    done
+done
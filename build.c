@@ -0,0 +1,215 @@
+/**
+ * One-step builds: `ptucc --build [-o prog] [-j jobs] in.ptuc... [cc flags]`
+ * translates each input and pipes the generated C straight into the
+ * standard input of the C compiler (`-x c -`), which is started before
+ * parsing begins; no intermediate .c file is written. Several inputs
+ * are built in parallel, each into a program named after it. The
+ * translation options of ptucc (-v, -d depth, -m macro_limit) apply to
+ * every input and are not passed to the C compiler.
+ *
+ * The C compiler is taken from $PTUCC_CC (default: gcc) and the runtime
+ * (ptuclib.h, libptuc.a) from $PTUCC_RTDIR (default: the build tree).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "cgen.h"
+#include "build.h"
+
+/* set by the Makefile to the directory holding the runtime */
+#ifndef PTUC_RTDIR
+#define PTUC_RTDIR "."
+#endif
+
+/* C compiler used unless $PTUCC_CC says otherwise */
+#ifndef PTUC_CC
+#define PTUC_CC "gcc"
+#endif
+
+/* a single compile with the given arguments (ptucc.c) */
+extern int compile_main(int argc, char **argv);
+
+/* print usage message for --build */
+static void
+build_usage() {
+    fprintf(stderr, "Example Usage:");
+    fprintf(stderr, "\n  ./ptucc --build infile.ptuc [cc flags]");
+    fprintf(stderr, "\n  ./ptucc --build -o [program] infile.ptuc [cc flags]");
+    fprintf(stderr, "\n  ./ptucc --build -j [jobs] a.ptuc b.ptuc ... [cc flags]");
+    fprintf(stderr, "\n  ./ptucc --build [-v] [-d depth] [-m macro_limit] infile.ptuc [cc flags]\n");
+}
+
+/* the compiler command line for building `output` from our stdin */
+static char **
+cc_argv(const char *output, int nflags, char **flags) {
+    const char *cc = getenv("PTUCC_CC"), *rt = getenv("PTUCC_RTDIR");
+    if (cc == NULL || *cc == '\0') { cc = PTUC_CC; }
+    if (rt == NULL || *rt == '\0') { rt = PTUC_RTDIR; }
+
+    /* the compiler may come with flags of its own, e.g. "gcc -g" */
+    char *words = strdup(cc);
+    char **argv = calloc(strlen(cc) / 2 + (size_t) nflags + 16, sizeof(*argv));
+    if (words == NULL || argv == NULL) { return NULL; }
+    int argc = 0;
+    for (char *w = strtok(words, " \t"); w; w = strtok(NULL, " \t")) { argv[argc++] = w; }
+    if (argc == 0) { return NULL; }
+
+    argv[argc++] = "-std=c11";
+    argv[argc++] = "-D_GNU_SOURCE";
+    argv[argc++] = "-I";
+    argv[argc++] = (char *) rt;
+    argv[argc++] = "-o";
+    argv[argc++] = (char *) output;
+    argv[argc++] = "-x";
+    argv[argc++] = "c";
+    argv[argc++] = "-";
+    /* anything after this (objects, -l...) is linked after the program */
+    argv[argc++] = "-x";
+    argv[argc++] = "none";
+    for (int i = 0; i < nflags; i++) { argv[argc++] = flags[i]; }
+    argv[argc++] = template("%s/libptuc.a", rt);
+    argv[argc] = NULL;
+    return argv;
+}
+
+/* translate `input` into the compiler's stdin, never returns */
+static void
+build_one(const char *input, const char *output, int nopts, char **opts,
+          int nflags, char **flags) {
+    char **argv = cc_argv(output, nflags, flags);
+    int p[2];
+    if (argv == NULL || pipe(p) != 0) {
+        fprintf(stderr, "\n -- Error: could not set up the C compiler for %s\n", input);
+        _exit(EXIT_FAILURE);
+    }
+
+    /* start the compiler first, it gets going while we parse */
+    pid_t cc = fork();
+    if (cc == 0) {
+        dup2(p[0], STDIN_FILENO);
+        close(p[0]);
+        close(p[1]);
+        execvp(argv[0], argv);
+        fprintf(stderr, "\n -- Error: could not run %s: %s\n", argv[0], strerror(errno));
+        _exit(127);
+    }
+    close(p[0]);
+    if (cc < 0) {
+        fprintf(stderr, "\n -- Error: could not start %s\n", argv[0]);
+        _exit(EXIT_FAILURE);
+    }
+
+    /* a compiler that died early is reported below, not by SIGPIPE */
+    signal(SIGPIPE, SIG_IGN);
+    /* the generated C goes to stdout, which is now the pipe */
+    dup2(p[1], STDOUT_FILENO);
+    close(p[1]);
+    /* ptucc's own options come first, the input last */
+    char **args = calloc((size_t) nopts + 3, sizeof(*args));
+    if (args == NULL) { _exit(EXIT_FAILURE); }
+    args[0] = "ptucc";
+    for (int i = 0; i < nopts; i++) { args[i + 1] = opts[i]; }
+    args[nopts + 1] = (char *) input;
+    int status = compile_main(nopts + 2, args);
+    /* nothing was generated, don't let the compiler chew on it */
+    if (status != EXIT_SUCCESS) { kill(cc, SIGTERM); }
+    fflush(stdout);
+    close(STDOUT_FILENO);
+
+    int cc_status = 0;
+    while (waitpid(cc, &cc_status, 0) < 0 && errno == EINTR) {}
+    bool cc_ok = WIFEXITED(cc_status) && WEXITSTATUS(cc_status) == 0;
+    fprintf(stderr, "\n ** %s -> %s: ptucc %s, %s %s\n", input, output,
+            status == EXIT_SUCCESS ? "succeeded" : "failed", argv[0],
+            status != EXIT_SUCCESS ? "skipped" : cc_ok ? "succeeded" : "failed");
+    _exit(status == EXIT_SUCCESS && cc_ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/**
+ * Run a build with the arguments following --build, returns the exit status.
+ */
+int
+run_build(int argc, char **argv) {
+    const char *out = NULL;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    char **inputs = calloc((size_t) argc + 1, sizeof(*inputs)),
+            **opts = calloc((size_t) argc + 1, sizeof(*opts)),
+            **flags = calloc((size_t) argc + 1, sizeof(*flags));
+    int ninputs = 0, nopts = 0, nflags = 0;
+    if (inputs == NULL || opts == NULL || flags == NULL) { return EXIT_FAILURE; }
+
+    /* our own options and inputs, the rest is for the C compiler */
+    for (int i = 0; i < argc; i++) {
+        size_t len = strlen(argv[i]);
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            opts[nopts++] = argv[i];
+        } else if ((strcmp(argv[i], "-d") == 0 || strcmp(argv[i], "-m") == 0) &&
+                   i + 1 < argc) {
+            /* translation options, checked by the compile itself */
+            opts[nopts++] = argv[i];
+            opts[nopts++] = argv[++i];
+        } else if (len > 5 && strcmp(argv[i] + len - 5, ".ptuc") == 0) {
+            inputs[ninputs++] = argv[i];
+        } else {
+            flags[nflags++] = argv[i];
+        }
+    }
+    if (ninputs == 0 || jobs < 1 || (out && ninputs > 1)) {
+        if (out && ninputs > 1) {
+            fprintf(stderr, "\n -- Error: -o can only be used with a single input\n");
+        }
+        build_usage();
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < ninputs; i++) {
+        if (access(inputs[i], R_OK) != 0) {
+            fprintf(stderr, "\n -- Error: could not open %s for reading...\n", inputs[i]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* keep up to `jobs` builds running */
+    int next = 0, running = 0, failed = 0;
+    while (next < ninputs || running > 0) {
+        while (running < jobs && next < ninputs) {
+            const char *input = inputs[next++];
+            char *output = out ? strdup(out) : swap_ext(input, "");
+            fflush(NULL);
+            pid_t pid = fork();
+            if (pid == 0) { build_one(input, output, nopts, opts, nflags, flags); }
+            free(output);
+            if (pid < 0) {
+                fprintf(stderr, "\n -- Error: could not start building %s\n", input);
+                failed++;
+            } else {
+                running++;
+            }
+        }
+        int status;
+        if (running == 0) { continue; }
+        if (wait(&status) < 0) {
+            if (errno == EINTR) { continue; }
+            break;
+        }
+        running--;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) { failed++; }
+    }
+
+    if (ninputs > 1) {
+        fprintf(stderr, "\n ** Built %d out of %d programs\n", ninputs - failed, ninputs);
+    }
+    free(inputs);
+    free(opts);
+    free(flags);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,17 @@
+/**
+ * One-step builds: `ptucc --build [-o prog] [-j jobs] in.ptuc... [cc flags]`
+ * translates each input and pipes the generated C straight into the
+ * standard input of the C compiler (`-x c -`), which is started before
+ * parsing begins; no intermediate .c file is written. Several inputs
+ * are built in parallel, each into a program named after it.
+ *
+ * The C compiler is taken from $PTUCC_CC (default: gcc) and the runtime
+ * (ptuclib.h, libptuc.a) from $PTUCC_RTDIR (default: the build tree).
+ */
+
+#pragma once
+
+/**
+ * Run a build with the arguments following --build, returns the exit status.
+ */
+int run_build(int argc, char **argv);
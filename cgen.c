@@ -9,6 +9,7 @@
 extern uint32_t line_num;
 extern uint32_t yylex_bufidx;
 extern hashtable_t *mac_ht;
+extern hashtable_t *arr_ht;
 
 extern int yylex_destroy();
 
@@ -36,10 +37,10 @@ void
 ssclose(sstream *S)
     {fclose(S->stream);}
 
-/* wrapper for cleaning flex and hashtable */
+/* wrapper for cleaning flex and hashtables */
 void
 flex_closure()
-    {yylex_destroy(); ht_destroy(mac_ht);}
+    {yylex_destroy(); ht_destroy(mac_ht); ht_destroy(arr_ht);}
 
 /*
     This function takes the same arguments as printf,
@@ -84,6 +85,17 @@ string_ptuc2c(char *P) {
 }
 
 
+/*
+    Return `path` with its extension (if any) replaced by `ext`.
+*/
+char *
+swap_ext(const char *path, const char *ext) {
+    const char *dot = strrchr(path, '.'), *slash = strrchr(path, '/');
+    int len = (dot && (!slash || dot > slash)) ?
+              (int) (dot - path) : (int) strlen(path);
+    return template("%.*s%s", len, path, ext);
+}
+
 /*
     Report errors
 */
@@ -44,3 +44,8 @@ extern const char *c_prologue;
     Return the corrected string (maybe the same as P).
 */
 char *string_ptuc2c(char *P);
+
+/*
+    Return `path` with its extension (if any) replaced by `ext`.
+*/
+char *swap_ext(const char *path, const char *ext);
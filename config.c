@@ -1,4 +1,6 @@
 #include "config.h"
+#include "cgen.h"
+#include "deps.h"
 
 /* parse command line arguments (return true on succ. false on failure) */
 bool
@@ -7,7 +9,8 @@ parse_args(int argc, char **argv, FILE **in) {
     if (argc < 0 || argv == NULL || in == NULL) { return false; }
 
     int16_t c, errflg = 0;
-    while ((c = getopt(argc, argv, "vo:i:d:m:h")) != -1) {
+    while ((c = getopt_long_only(argc, argv, "vo:i:d:m:h",
+                                 long_opts, NULL)) != -1) {
         switch (c) {
             case 'v': {
                 verbose_flag = true;
@@ -51,6 +54,26 @@ parse_args(int argc, char **argv, FILE **in) {
                 }
                 break;
             }
+            case 'D': {
+                deps_flag = true;
+                break;
+            }
+            case 'F': {
+                dep_name = optarg;
+                break;
+            }
+            case 'T': {
+                dep_target = optarg;
+                break;
+            }
+            case 'P': {
+                deps_phony = true;
+                break;
+            }
+            case 'S': {
+                skip_flag = true;
+                break;
+            }
             case ':': {
                 fprintf(stderr,
                         "\n\t -- Error: Option -%c requires an operand", c);
@@ -94,6 +117,46 @@ parse_args(int argc, char **argv, FILE **in) {
         /* now leave it at stdin (from < op) */
     }
 
+    /* dependency output, the file name defaults to the output's */
+    if ((dep_name || dep_target || deps_phony) && !deps_flag) {
+        fprintf(stderr, "\n -- Error: -MF, -MT and -MP require -MD\n");
+        return false;
+    }
+    if (deps_flag && !dep_name) {
+        if (!fout_name && !fin_name) {
+            fprintf(stderr,
+                    "\n -- Error: -MD needs -MF when using standard input and output\n");
+            return false;
+        }
+        dep_name = swap_ext(fout_name ? fout_name : fin_name, ".d");
+    }
+    /* likewise the target defaults to a file name we know about */
+    if (deps_flag && !dep_target && !fout_name && !fin_name) {
+        fprintf(stderr,
+                "\n -- Error: -MD needs -MT when using standard input and output\n");
+        return false;
+    }
+
+    /* skipping needs files on both ends to stamp */
+    if (skip_flag) {
+        if (!fout_name || !fin_name) {
+            fprintf(stderr,
+                    "\n -- Error: --skip-unchanged requires an input file and -o\n");
+            return false;
+        }
+        if (stamp_unchanged(argc, argv, fin_name, fout_name) &&
+            (!deps_flag || access(dep_name, F_OK) == 0)) {
+            up_to_date = true;
+            return true;
+        }
+        /* a stale stamp must not survive a failed compile */
+        char *sname = stamp_name(fout_name);
+        if (sname) {
+            unlink(sname);
+            free(sname);
+        }
+    }
+
     /* if verbose flag, inform the user */
     if (verbose_flag) {
         fprintf(stderr, "\n -- Setting max_macro: %d, max limit: %d", max_macro, max_macro_max);
@@ -132,6 +195,11 @@ print_usage() {
     fprintf(stderr, "\n  ./ptucc -i [infile] -o [outfile]");
     fprintf(stderr, "\n  ./ptucc -i [infile] -o [outfile] -d [depth]");
     fprintf(stderr, "\n  ./ptucc -i [infile] -o [outfile] -d [depth] -m [macro_limit]");
+    fprintf(stderr, "\n  ./ptucc -i [infile] -o [outfile] -MD [-MF depfile] [-MT target] [-MP]");
+    fprintf(stderr, "\n  ./ptucc -i [infile] -o [outfile] --skip-unchanged");
+    fprintf(stderr, "\n  ./ptucc --build [-o program] [-j jobs] infile.ptuc... [cc flags]");
+    fprintf(stderr, "\n  ./ptucc --server [socket]");
+    fprintf(stderr, "\n  ./ptucc --client [socket] [any of the above]");
     fprintf(stderr, "\n  ./ptucc -h (prints this)");
     fprintf(stderr, "\n  ./ptucc infile.ptuc");
     fprintf(stderr, "\n  ./ptucc < infile.ptuc > outfile.c\n");
@@ -143,3 +211,25 @@ close_fptrs() {
     if (fout_ptr) { fclose(fout_ptr); }
     if (fin_ptr) { fclose(fin_ptr); }
 }
+
+/* write the dependency file and stamp after a successful compile */
+bool
+write_build_info(int argc, char **argv) {
+    bool ok = true;
+    if (deps_flag) {
+        char *target = dep_target ? strdup(dep_target) :
+                       fout_name ? strdup(fout_name) :
+                       swap_ext(fin_name, ".c");
+        if (!target || !deps_write(dep_name, target, fin_name, deps_phony)) {
+            fprintf(stderr, "\n -- Error: could not write dependencies to %s", dep_name);
+            ok = false;
+        }
+        free(target);
+    }
+    if (skip_flag && !stamp_write(argc, argv, fin_name, fout_name)) {
+        fprintf(stderr, "\n -- Error: could not write the stamp of %s", fout_name);
+        ok = false;
+    }
+    deps_clear();
+    return ok;
+}
@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <getopt.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -12,11 +13,17 @@ bool verbose_flag = false,   // v-flag
         fin_flag = false,       // i-flag
         yystack_flag = false,   // d-flag
         macro_flag = false,     // m-flag
-        help_flag = false;      // h-flag
+        help_flag = false,      // h-flag
+        deps_flag = false,      // MD-flag
+        deps_phony = false,     // MP-flag
+        skip_flag = false,      // skip-unchanged flag
+        up_to_date = false;     // set when skip-unchanged found no changes
 
 /* in case we have a file for specific input/output */
 char *fout_name = NULL,  // output .c in this file
-        *fin_name = NULL;   // read the .ptuc file pointed here
+        *fin_name = NULL,   // read the .ptuc file pointed here
+        *dep_name = NULL,   // write the dependency rule here (MF)
+        *dep_target = NULL; // target of the dependency rule (MT)
 
 FILE *fout_ptr = NULL,   // output FILE pointer            
         *fin_ptr = NULL;    // in FILE pointer
@@ -30,6 +37,16 @@ uint32_t yystack_depth = 10;
 uint32_t max_macro = 64;
 uint32_t max_macro_max = 256;
 
+/* long options, matched with a single dash as well (gcc style) */
+static const struct option long_opts[] = {
+        {"MD",             no_argument,       NULL, 'D'},
+        {"MF",             required_argument, NULL, 'F'},
+        {"MT",             required_argument, NULL, 'T'},
+        {"MP",             no_argument,       NULL, 'P'},
+        {"skip-unchanged", no_argument,       NULL, 'S'},
+        {NULL, 0,                             NULL, 0}
+};
+
 /* print usage message */
 void
         print_usage();
@@ -42,3 +59,7 @@ bool
 void
         close_fptrs();
 
+/* write the dependency file and stamp after a successful compile */
+bool
+        write_build_info(int argc, char **argv);
+
@@ -0,0 +1,224 @@
+/**
+ * Dependency tracking for incremental builds: every module opened
+ * through `use` is recorded so that we can emit a make-compatible
+ * dependency file (-MD/-MF) and a stamp of the hashed inputs which
+ * lets --skip-unchanged avoid recompiling unchanged files.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include "cgen.h"
+#include "deps.h"
+
+/* stamp file format version, bump when the hashed data changes */
+#define STAMP_MAGIC "ptucc-stamp 2"
+
+/* FNV-1a parameters */
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/* the recorded modules, in the order they were opened */
+static char **dep_names = NULL;
+static uint32_t dep_cnt = 0, dep_cap = 0;
+
+/**
+ * Record a module file that was opened while compiling.
+ */
+bool
+deps_add(const char *fname) {
+    /* a module used twice is only listed once */
+    for (uint32_t i = 0; i < dep_cnt; i++) {
+        if (strcmp(dep_names[i], fname) == 0) { return true; }
+    }
+    if (dep_cnt == dep_cap) {
+        uint32_t cap = dep_cap ? dep_cap * 2 : 16;
+        char **n = realloc(dep_names, cap * sizeof(*n));
+        if (n == NULL) { return false; }
+        dep_names = n;
+        dep_cap = cap;
+    }
+    if ((dep_names[dep_cnt] = strdup(fname)) == NULL) { return false; }
+    dep_cnt++;
+    return true;
+}
+
+/**
+ * Number of modules recorded so far and access to them.
+ */
+uint32_t
+deps_count()
+    {return dep_cnt;}
+
+const char *
+deps_get(uint32_t idx)
+    {return idx < dep_cnt ? dep_names[idx] : NULL;}
+
+/**
+ * Release the recorded modules.
+ */
+void
+deps_clear() {
+    for (uint32_t i = 0; i < dep_cnt; i++) { free(dep_names[i]); }
+    free(dep_names);
+    dep_names = NULL;
+    dep_cnt = dep_cap = 0;
+}
+
+/* write a file name escaping the characters make treats specially */
+static void
+deps_put_name(FILE *f, const char *s) {
+    for (; *s; s++) {
+        if (*s == ' ' || *s == '#' || *s == '\\') { fputc('\\', f); }
+        if (*s == '$') { fputc('$', f); }
+        fputc(*s, f);
+    }
+}
+
+/**
+ * Write a make rule `target: input modules...` into `depfile`;
+ * when `phony` is set an empty rule for each module is added as well,
+ * so deleting a module does not break the build.
+ */
+bool
+deps_write(const char *depfile, const char *target,
+           const char *input, bool phony) {
+    FILE *f = fopen(depfile, "w");
+    if (f == NULL) { return false; }
+
+    deps_put_name(f, target);
+    fputc(':', f);
+    if (input) {
+        fputc(' ', f);
+        deps_put_name(f, input);
+    }
+    for (uint32_t i = 0; i < dep_cnt; i++) {
+        fputs(" \\\n  ", f);
+        deps_put_name(f, dep_names[i]);
+    }
+    fputc('\n', f);
+
+    if (phony) {
+        for (uint32_t i = 0; i < dep_cnt; i++) {
+            fputc('\n', f);
+            deps_put_name(f, dep_names[i]);
+            fputs(":\n", f);
+        }
+    }
+    return fclose(f) == 0;
+}
+
+/* fold `len` bytes into a FNV-1a hash */
+static uint64_t
+fnv_bytes(uint64_t h, const void *p, size_t len) {
+    const unsigned char *b = p;
+    for (size_t i = 0; i < len; i++) {
+        h ^= b[i];
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+/* fold a file name and its contents into the hash */
+static uint64_t
+fnv_file(uint64_t h, const char *fname) {
+    char buf[1 << 16];
+    size_t n;
+    FILE *f = fopen(fname, "rb");
+
+    h = fnv_bytes(h, fname, strlen(fname) + 1);
+    /* a missing file hashes differently from an empty one */
+    if (f == NULL) { return fnv_bytes(h, "\xff", 1); }
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) { h = fnv_bytes(h, buf, n); }
+    fclose(f);
+    return h;
+}
+
+/* hash of the arguments and the main input */
+static uint64_t
+stamp_base(int argc, char **argv, const char *input) {
+    uint64_t h = fnv_bytes(FNV_OFFSET, STAMP_MAGIC, sizeof(STAMP_MAGIC));
+    /* a rebuilt or upgraded ptucc may generate different code */
+    struct stat st;
+    const char *build = __DATE__ " " __TIME__;
+    h = fnv_bytes(h, build, strlen(build) + 1);
+    if (stat("/proc/self/exe", &st) == 0) {
+        h = fnv_bytes(h, &st.st_dev, sizeof(st.st_dev));
+        h = fnv_bytes(h, &st.st_ino, sizeof(st.st_ino));
+        h = fnv_bytes(h, &st.st_size, sizeof(st.st_size));
+        h = fnv_bytes(h, &st.st_mtim, sizeof(st.st_mtim));
+    }
+    for (int i = 1; i < argc; i++) { h = fnv_bytes(h, argv[i], strlen(argv[i]) + 1); }
+    return fnv_file(h, input);
+}
+
+/**
+ * Name of the stamp file kept next to `out`, to be freed by the caller.
+ */
+char *
+stamp_name(const char *out)
+    {return template("%s.stamp", out);}
+
+/**
+ * Check the stamp of `out` against the hash of the arguments, the
+ * input and the modules recorded in the stamp by the last build.
+ */
+bool
+stamp_unchanged(int argc, char **argv,
+                const char *input, const char *out) {
+    char *sname = stamp_name(out), *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    uint64_t want = 0, h;
+    bool ok = false;
+    FILE *f = NULL;
+
+    /* nothing to skip if the output is gone */
+    if (access(out, F_OK) != 0 || sname == NULL ||
+        (f = fopen(sname, "r")) == NULL) {
+        free(sname);
+        return false;
+    }
+    h = stamp_base(argc, argv, input);
+
+    /* header, hash and then one module per line */
+    if (getline(&line, &cap, f) <= 0 ||
+        strcmp(line, STAMP_MAGIC "\n") != 0) { goto out; }
+    if (getline(&line, &cap, f) <= 0 ||
+        sscanf(line, "hash %16" SCNx64, &want) != 1) { goto out; }
+    while ((len = getline(&line, &cap, f)) > 0) {
+        if (line[len - 1] == '\n') { line[len - 1] = '\0'; }
+        if (strncmp(line, "dep ", 4) != 0) { goto out; }
+        h = fnv_file(h, line + 4);
+    }
+    ok = h == want;
+
+out:
+    free(line);
+    fclose(f);
+    free(sname);
+    return ok;
+}
+
+/**
+ * Store the hash of the arguments, the input and the modules
+ * recorded during this build next to `out`.
+ */
+bool
+stamp_write(int argc, char **argv,
+            const char *input, const char *out) {
+    char *sname = stamp_name(out);
+    if (sname == NULL) { return false; }
+
+    uint64_t h = stamp_base(argc, argv, input);
+    for (uint32_t i = 0; i < dep_cnt; i++) { h = fnv_file(h, dep_names[i]); }
+
+    FILE *f = fopen(sname, "w");
+    free(sname);
+    if (f == NULL) { return false; }
+    fprintf(f, "%s\nhash %016" PRIx64 "\n", STAMP_MAGIC, h);
+    for (uint32_t i = 0; i < dep_cnt; i++) { fprintf(f, "dep %s\n", dep_names[i]); }
+    return fclose(f) == 0;
+}
@@ -0,0 +1,56 @@
+/**
+ * Dependency tracking for incremental builds: every module opened
+ * through `use` is recorded so that we can emit a make-compatible
+ * dependency file (-MD/-MF) and a stamp of the hashed inputs which
+ * lets --skip-unchanged avoid recompiling unchanged files.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Record a module file that was opened while compiling.
+ */
+bool deps_add(const char *fname);
+
+/**
+ * Number of modules recorded so far and access to them.
+ */
+uint32_t deps_count();
+
+const char *deps_get(uint32_t idx);
+
+/**
+ * Release the recorded modules.
+ */
+void deps_clear();
+
+/**
+ * Write a make rule `target: input modules...` into `depfile`;
+ * when `phony` is set an empty rule for each module is added as well,
+ * so deleting a module does not break the build.
+ */
+bool deps_write(const char *depfile, const char *target,
+                const char *input, bool phony);
+
+/**
+ * Name of the stamp file kept next to `out`, to be freed by the caller.
+ */
+char *stamp_name(const char *out);
+
+/**
+ * Check the stamp of `out` against the hash of the arguments, the
+ * input and the modules recorded in the stamp by the last build.
+ */
+bool stamp_unchanged(int argc, char **argv,
+                     const char *input, const char *out);
+
+/**
+ * Store the hash of the arguments, the input and the modules
+ * recorded during this build next to `out`.
+ */
+bool stamp_write(int argc, char **argv,
+                 const char *input, const char *out);
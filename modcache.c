@@ -0,0 +1,154 @@
+/**
+ * In-memory cache of module sources for the compile server. The
+ * server process keeps the contents of every module its requests
+ * used; requests run in forked children which inherit the cache and
+ * read cached modules from memory instead of the disk. Entries are
+ * keyed by device and inode and are only used while the modification
+ * time and size of the file still match.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "modcache.h"
+
+/* cache entry structure */
+typedef struct mc_entry {
+    dev_t dev;                  // device of the module file.
+    ino_t ino;                  // inode of the module file.
+    struct timespec mtime;      // modification time when loaded.
+    off_t size;                 // size when loaded.
+    char *data;                 // file contents.
+    struct mc_entry *next;      // our next pointer.
+} mc_entry_t;
+
+/* cached modules */
+static mc_entry_t *mc_head = NULL;
+
+/* where to report misses (-1 for nowhere) */
+static int mc_report_fd = -1;
+
+/* find the entry of the file described by `st` */
+static mc_entry_t *
+mc_find(const struct stat *st) {
+    for (mc_entry_t *e = mc_head; e != NULL; e = e->next) {
+        if (e->dev == st->st_dev && e->ino == st->st_ino) { return e; }
+    }
+    return NULL;
+}
+
+/* check if the entry still matches the file on disk */
+static bool
+mc_fresh(const mc_entry_t *e, const struct stat *st) {
+    return e->size == st->st_size &&
+           e->mtime.tv_sec == st->st_mtim.tv_sec &&
+           e->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+/* tell the server which module it should cache */
+static void
+mc_report(const char *fname) {
+    char cwd[PATH_MAX], *line;
+    int len;
+
+    if (fname[0] == '/') {
+        len = asprintf(&line, "%s\n", fname);
+    } else {
+        if (getcwd(cwd, sizeof(cwd)) == NULL) { return; }
+        len = asprintf(&line, "%s/%s\n", cwd, fname);
+    }
+    if (len < 0) { return; }
+    /* reports are short enough to be written atomically */
+    if (write(mc_report_fd, line, (size_t) len) < 0) {}
+    free(line);
+}
+
+/**
+ * Open `fname` from the cache; returns NULL on a miss (in which case
+ * the caller opens the file itself) after reporting the miss to the
+ * server, if any.
+ */
+FILE *
+modcache_open(const char *fname) {
+    struct stat st;
+
+    /* nothing cached and nobody to tell, don't bother */
+    if (mc_head == NULL && mc_report_fd < 0) { return NULL; }
+    if (stat(fname, &st) != 0) { return NULL; }
+
+    mc_entry_t *e = mc_find(&st);
+    if (e != NULL && mc_fresh(e, &st) && e->size > 0) {
+        return fmemopen(e->data, (size_t) e->size, "r");
+    }
+    if (mc_report_fd >= 0) { mc_report(fname); }
+    return NULL;
+}
+
+/**
+ * Load (or refresh) `path` into the cache.
+ */
+bool
+modcache_load(const char *path) {
+    struct stat st;
+    FILE *f = fopen(path, "r");
+    if (f == NULL) { return false; }
+    if (fstat(fileno(f), &st) != 0) {
+        fclose(f);
+        return false;
+    }
+
+    mc_entry_t *e = mc_find(&st);
+    if (e != NULL && mc_fresh(e, &st)) {
+        fclose(f);
+        return true;
+    }
+
+    char *data = malloc((size_t) st.st_size + 1);
+    if (data == NULL ||
+        fread(data, 1, (size_t) st.st_size, f) != (size_t) st.st_size) {
+        free(data);
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+    data[st.st_size] = '\0';
+
+    if (e == NULL) {
+        if ((e = calloc(1, sizeof(*e))) == NULL) {
+            free(data);
+            return false;
+        }
+        e->dev = st.st_dev;
+        e->ino = st.st_ino;
+        e->next = mc_head;
+        mc_head = e;
+    }
+    free(e->data);
+    e->data = data;
+    e->size = st.st_size;
+    e->mtime = st.st_mtim;
+    return true;
+}
+
+/**
+ * Report cache misses as newline separated absolute paths to `fd`
+ * (-1 disables reporting).
+ */
+void
+modcache_report_to(int fd)
+    {mc_report_fd = fd;}
+
+/**
+ * Drop every cached module.
+ */
+void
+modcache_destroy() {
+    while (mc_head != NULL) {
+        mc_entry_t *e = mc_head;
+        mc_head = e->next;
+        free(e->data);
+        free(e);
+    }
+}
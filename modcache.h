@@ -0,0 +1,36 @@
+/**
+ * In-memory cache of module sources for the compile server. The
+ * server process keeps the contents of every module its requests
+ * used; requests run in forked children which inherit the cache and
+ * read cached modules from memory instead of the disk. Entries are
+ * keyed by device and inode and are only used while the modification
+ * time and size of the file still match.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdbool.h>
+
+/**
+ * Open `fname` from the cache; returns NULL on a miss (in which case
+ * the caller opens the file itself) after reporting the miss to the
+ * server, if any.
+ */
+FILE *modcache_open(const char *fname);
+
+/**
+ * Load (or refresh) `path` into the cache.
+ */
+bool modcache_load(const char *path);
+
+/**
+ * Report cache misses as newline separated absolute paths to `fd`
+ * (-1 disables reporting).
+ */
+void modcache_report_to(int fd);
+
+/**
+ * Drop every cached module.
+ */
+void modcache_destroy();
@@ -2,11 +2,16 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <string.h>
 #include "cgen.h"
+#include "server.h"
+#include "build.h"
 #include "ptucc_parser.tab.h"
 
 extern FILE *yyin;
 extern char *fin_name;
+extern char *fout_name;
+extern bool up_to_date;
 
 /* parse command line arguments (return 1 on succ. -1 on failure) */
 extern int parse_args(int argc, char **argv, FILE **in);
@@ -14,18 +19,53 @@ extern int parse_args(int argc, char **argv, FILE **in);
 /* close file pointers (if any) */
 extern void close_fptrs();
 
-int main(int argc, char **argv) {
+/* write the dependency file and stamp after a successful compile */
+extern bool write_build_info(int argc, char **argv);
+
+/* a single compile with the given arguments, returns the exit status */
+int
+compile_main(int argc, char **argv) {
+    bool parsed = false, ok = false;
     if (parse_args(argc, argv, &yyin)) {
-        fprintf(stderr, "\n\n ** Parsing from %s\n\n",
-                fin_name ? fin_name : "standard input");
-        yyparse();
-        fprintf(stderr, "\n ** End of parsing -- %s\n",
-                yyerror_count > 0 ? "failed to parse given input." :
-                "successfully parsed given input.");
+        if (up_to_date) {
+            fprintf(stderr, "\n ** %s is up to date with %s\n",
+                    fout_name, fin_name);
+            ok = true;
+        } else {
+            fprintf(stderr, "\n\n ** Parsing from %s\n\n",
+                    fin_name ? fin_name : "standard input");
+            yyparse();
+            fprintf(stderr, "\n ** End of parsing -- %s\n",
+                    yyerror_count > 0 ? "failed to parse given input." :
+                    "successfully parsed given input.");
+            ok = parsed = yyerror_count == 0;
+        }
     }
     close_fptrs();
+    /* the output is complete only now, record what it was built from */
+    if (parsed) { ok = write_build_info(argc, argv); }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-
-
-
+int main(int argc, char **argv) {
+    /* build/server/client modes take over the whole command line */
+    if (argc > 1 && strcmp(argv[1], "--build") == 0) {
+        return run_build(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) {
+        if (argc == 3) { return run_server(argv[2]); }
+        fprintf(stderr, "Usage: %s --server [socket]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (argc > 1 && strcmp(argv[1], "--client") == 0) {
+        if (argc >= 3) {
+            char *sock_path = argv[2];
+            /* forward the rest as a regular ptucc command line */
+            argv[2] = argv[0];
+            return run_client(sock_path, argc - 2, argv + 2);
+        }
+        fprintf(stderr, "Usage: %s --client [socket] [ptucc args...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    return compile_main(argc, argv);
+}
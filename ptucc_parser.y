@@ -12,6 +12,7 @@
 extern int yylex(void);
 extern uint32_t line_num;
 extern FILE **fout_ref;
+extern uint32_t fetch_line_count();
 
 /*  handy clean-up function */
 void 
@@ -39,6 +40,21 @@ char *ident_to_array(char *s, char *array_pad);
 /* pad cdata to identifiers */
 char *ident_to_cdata(char *s, char *cdata);
 
+/* declare identifiers as dynamic arrays, pointerizing them if asked */
+char *ident_to_dynarray(char *s, bool pointerize);
+
+/* bounds-check the first index of ident[index]... */
+char *ident_index(char *ident, char *brackets);
+
+/* names of declared types, mapped to "1" if they are `array of` types */
+hashtable_t *arr_ht = NULL;
+
+/* remember if type `name` is an `array of` type */
+void mark_type(char *name, bool array);
+
+/* check if `name` is an `array of` type */
+bool is_array_type(char *name);
+
 %}
 
 
@@ -315,8 +331,10 @@ func_decl:
         KW_COLON cdata_with_type KW_SEMICOLON
         decls func_body KW_SEMICOLON
         {
-            $$ = template("%s %s(%s) {%s result;\n%s\n%s\nreturn result;}\n",
-                $7, $2, $4, $7, $9, $10);
+            /* an array result starts out empty and is handed to the caller unowned */
+            $$ = template("%s %s(%s) {%s result%s;\n%s\n%s\nreturn result;}\n",
+                $7, $2, $4, $7, is_array_type($7) ? " PTUC_RESULT = NULL" : "",
+                $9, $10);
             tf($2); tf($4); tf($7); tf($9); tf($10);
         }
     ;
@@ -377,17 +395,23 @@ type_decl_list:
 /* type with data types */       
 type_decl_single:
       IDENT KW_EQ cdata_with_type KW_SEMICOLON 
-        {$$ = template("\ttypedef %s %s;", $3, $1); tf($1); tf($3);}
+        {
+          /* aliases of `array of` types are dynamic arrays as well */
+          mark_type($1, is_array_type($3));
+          $$ = template("\ttypedef %s %s;", $3, $1); tf($1); tf($3);
+        }
       
       | IDENT KW_EQ KW_ARRAY KW_OF 
                       cdata_with_type KW_SEMICOLON
         {
+          mark_type($1, true);
           $$ = template("\ttypedef %s* %s;", $5, $1); 
           tf($1); tf($5);
         }
       | IDENT KW_EQ KW_ARRAY brackets_list KW_OF 
                       cdata_with_type KW_SEMICOLON
         {
+          mark_type($1, false);
           $$ = template("\ttypedef %s %s%s;", $6, $1, $4); 
           tf($1); tf($4); tf($6);
         }
@@ -395,12 +419,14 @@ type_decl_single:
               KW_LPAR type_only_arguments KW_RPAR KW_COLON 
               cdata_with_type KW_SEMICOLON
         {
+          mark_type($1, false);
           $$ = template("\ttypedef %s (*%s)(%s);", $8, $1, $5);
           tf($1); tf($5); tf($8);
         }
        | IDENT KW_EQ KW_PROCEDURE 
               KW_LPAR type_only_arguments KW_RPAR KW_SEMICOLON
         {
+          mark_type($1, false);
           $$ = template("\ttypedef void (*%s)(%s);", $1, $5);
           tf($1); tf($5);
         } 
@@ -420,11 +446,22 @@ var_decl_list:
         
 var_decl_single:
       ident_list KW_COLON cdata_with_type KW_SEMICOLON 
-        {$$ = template("\t%s %s;\n", $3, $1); tf($1); tf($3);}
+        {
+          if(!is_array_type($3))
+            {$$ = template("\t%s %s;\n", $3, $1); tf($1); tf($3);}
+          else {
+            /* variables of `array of` types own their arrays */
+            char *s = ident_to_dynarray($1, false);
+            if(s == NULL) 
+              {tf($3); yyerror("No memory to allocate in order to declare arrays");}
+            else
+              {$$ = template("\t%s %s;\n", $3, s); tf($1); tf($3); tf(s);}
+          }
+        }
       | ident_list KW_COLON KW_ARRAY KW_OF cdata_with_type KW_SEMICOLON 
         {
-          /* pointerize the identifier list */
-          char *s = ident_to_pointer($1);
+          /* pointerize the identifier list, the arrays are owned by it */
+          char *s = ident_to_dynarray($1, true);
           if(s == NULL) 
             {tf(s); tf($5); yyerror("No memory to allocate in order to pointerize");}
           else
@@ -454,7 +491,7 @@ ident_with_bracket:
         IDENT 
           {$$ = $1;}
         | IDENT brackets_list 
-          {$$ = template("%s%s", $1, $2); tf($1); tf($2);}
+          {$$ = ident_index($1, $2); tf($1); tf($2);}
         ;    
     
 
@@ -489,7 +526,11 @@ statement:
 /* handle assignment operator (:=) */
 assign_stmt:
       ident_with_bracket KW_OP_ASSIGN exp_join 
-        {$$ = template("%s = %s;\n", $1, $3); tf($1); tf($3);}
+        {
+          /* variables may hold arrays, the runtime tracks who owns them */
+          $$ = template(strchr($1, '[') ? "%s = %s;\n" : "PTUC_ASSIGN(%s, %s);\n", $1, $3);
+          tf($1); tf($3);
+        }
       ;
          
 while_stmt:
@@ -588,7 +629,7 @@ func_while_stmt:
 
 result_stmt:
          KW_RESULT KW_OP_ASSIGN func_exp_join
-          {$$ = template("result = %s;\n", $3); tf($3);}
+          {$$ = template("PTUC_ASSIGN(result, %s);\n", $3); tf($3);}
          ;
         
 func_ret_stmt:        
@@ -662,7 +703,7 @@ func_arguments :
 func_arglist:
        func_exp_join
         {$$ = $1;}
-       | arglist KW_COMMA func_exp_join 			
+       | func_arglist KW_COMMA func_exp_join 			
         {$$ = template("%s,%s", $1, $3); tf($1); tf($3);}
        ;
 
@@ -917,3 +958,58 @@ ident_to_cdata(char *s, char *cdata) {
     return new_buf;
 }
 
+/* declare identifiers as dynamic arrays, pointerizing them if asked */
+char *
+ident_to_dynarray(char *s, bool pointerize) {
+    if(s == NULL || strcmp(s, "") == 0)
+    {return "";}
+    /* find the number of variables */
+    uint32_t vars = find_counts(s, ',');
+    const char *pre = pointerize ? " *" : "",
+            *post = " PTUC_ARRAY = NULL";
+    /*
+      len of 's' plus the padding for `vars`+1 identifiers
+      plus the null byte
+    */
+    size_t buf_len = strlen(s)+
+                     ((vars+1)*(strlen(pre)+strlen(post)))+1;
+    char *cur_tok = strtok(s, ","),
+            *new_buf = calloc(buf_len, sizeof(char));
+    if(new_buf == NULL)
+    {return NULL;}
+    while(cur_tok != NULL) {
+        strcat(new_buf, pre);
+        strcat(new_buf, cur_tok);
+        strcat(new_buf, post);
+        cur_tok = strtok(NULL, ",");
+        if(cur_tok != NULL)
+        {strcat(new_buf, ",");}
+    }
+    return new_buf;
+}
+
+/* bounds-check the first index of ident[index]... */
+char *
+ident_index(char *ident, char *brackets) {
+    /* brackets are "[index]..." as built by brackets_list */
+    char *close = strchr(brackets, ']');
+    return template("%s[PTUC_INDEX(%s, %.*s, %u)]%s",
+                    ident, ident, (int) (close - brackets - 1), brackets + 1,
+                    fetch_line_count(), close + 1);
+}
+
+/* remember if type `name` is an `array of` type */
+void
+mark_type(char *name, bool array) {
+    if(arr_ht == NULL && (arr_ht = ht_create(64, NULL)) == NULL)
+    {yyerror("\n -- Error: Hashtable creation failed"); return;}
+    /* redeclarations replace the previous kind */
+    ht_set(arr_ht, name, array ? "1" : "0");
+}
+
+/* check if `name` is an `array of` type */
+bool
+is_array_type(char *name) {
+    char *kind = ht_get(arr_ht, name);
+    return kind != NULL && strcmp(kind, "1") == 0;
+}
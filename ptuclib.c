@@ -0,0 +1,565 @@
+#include <limits.h>
+#include "ptuclib.h"
+
+/*
+  Out-of-line part of the ptuc runtime, built into libptuc.a/.so;
+  the hot write helpers live as static inline functions in ptuclib.h.
+*/
+
+/* output buffer state */
+char ptuc_obuf[PTUC_OBUF_SIZE];
+size_t ptuc_olen = 0;
+/* 0: not initialised yet, 1: buffered, 2: flush on every write (tty) */
+int ptuc_omode = 0;
+
+/* input buffer state (one spare byte to null-terminate in place) */
+char ptuc_ibuf[PTUC_IBUF_SIZE + 1];
+size_t ptuc_ipos = 0, ptuc_ilen = 0;
+bool ptuc_ieof = false;
+
+/* growable buffer for lines that do not fit in the input buffer */
+static char *ptuc_line = NULL;
+static size_t ptuc_line_cap = 0;
+
+/* two-digit lookup table used by the integer formatter */
+const char ptuc_digits[201] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+/* exactly representable powers of ten */
+static const double ptuc_pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* write the output buffer out to stdout */
+void
+flushOutput() {
+    size_t off = 0;
+    /* do not let a flush clobber the errno a program might inspect */
+    int saved_errno = errno;
+    while (off < ptuc_olen) {
+        ssize_t n = write(STDOUT_FILENO, ptuc_obuf + off, ptuc_olen - off);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { break; }
+        off += (size_t) n;
+    }
+    ptuc_olen = 0;
+    errno = saved_errno;
+}
+
+/* lazily pick the output mode and make sure we flush at exit */
+void
+ptuc_out_init() {
+    /* isatty() sets errno (ENOTTY) when stdout is not a terminal */
+    int saved_errno = errno;
+    ptuc_omode = isatty(STDOUT_FILENO) ? 2 : 1;
+    atexit(flushOutput);
+    errno = saved_errno;
+}
+
+/* write `len` bytes straight to stdout, bypassing the buffer */
+void
+ptuc_write_direct(const char *s, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, s, len);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { break; }
+        s += n;
+        len -= (size_t) n;
+    }
+}
+
+/*
+  "%g" fast path for 1e-4 <= |x| < 1e6: scale to six significant
+  digits and round; values too close to a rounding tie to decide
+  safely return false and are left to snprintf.
+*/
+static bool
+ptuc_put_g(double x) {
+    double ax = x < 0 ? -x : x;
+    if (!(ax >= 1e-4 && ax < 1e6)) { return false; }
+    /* decimal exponent of the leading digit */
+    int e = 5;
+    while (e > 0 && ax < ptuc_pow10[e]) { e--; }
+    while (e <= 0 && ax * ptuc_pow10[-e] < 1) { e--; }
+    double v = ax * ptuc_pow10[5 - e];
+    uint64_t m = (uint64_t) v;
+    double frac = v - (double) m;
+    if (frac > 0.5 - 1e-9 && frac < 0.5 + 1e-9) { return false; }
+    if (frac > 0.5) { m++; }
+    if (m < 100000 || m >= 1000000) { return false; }
+
+    char digs[6], *p = ptuc_obuf + ptuc_olen;
+    ptuc_fmt_u64(digs + 6, m);
+    int last = 5;
+    while (digs[last] == '0') { last--; }
+    if (x < 0) { *p++ = '-'; }
+    if (e >= 0) {
+        memcpy(p, digs, (size_t) e + 1);
+        p += e + 1;
+        if (last > e) {
+            *p++ = '.';
+            memcpy(p, digs + e + 1, (size_t) (last - e));
+            p += last - e;
+        }
+    } else {
+        *p++ = '0';
+        *p++ = '.';
+        for (int z = -1; z > e; z--) { *p++ = '0'; }
+        memcpy(p, digs, (size_t) last + 1);
+        p += last + 1;
+    }
+    ptuc_olen = (size_t) (p - ptuc_obuf);
+    return true;
+}
+
+/* same output as printf("%g") */
+void
+writeReal(double x) {
+    ptuc_out_reserve(PTUC_NUM_MAX);
+    /* integral values below 1e6 print as plain integers under %g */
+    if (x > -1e6 && x < 1e6 && (double) (int32_t) x == x) {
+        if (x == 0 && signbit(x)) { ptuc_obuf[ptuc_olen++] = '-'; }
+        ptuc_put_i64((int32_t) x);
+    } else if (!ptuc_put_g(x)) {
+        ptuc_olen += (size_t) snprintf(ptuc_obuf + ptuc_olen,
+                                       PTUC_NUM_MAX, "%g", x);
+    }
+    ptuc_out_done();
+}
+
+/* same output as printf("%f") */
+void
+writeFloat(double x) {
+    ptuc_out_reserve(PTUC_NUM_MAX);
+    /* integral values print as the integer followed by six zeros */
+    if (x > -1e15 && x < 1e15 && (double) (int64_t) x == x) {
+        if (x == 0 && signbit(x)) { ptuc_obuf[ptuc_olen++] = '-'; }
+        ptuc_put_i64((int64_t) x);
+        memcpy(ptuc_obuf + ptuc_olen, ".000000", 7);
+        ptuc_olen += 7;
+    } else {
+        ptuc_olen += (size_t) snprintf(ptuc_obuf + ptuc_olen,
+                                       PTUC_NUM_MAX, "%f", x);
+    }
+    ptuc_out_done();
+}
+
+/* copy `n` bytes at the end of the spill line buffer */
+static bool
+ptuc_line_append(size_t used, const char *s, size_t n) {
+    if (used + n + 1 > ptuc_line_cap) {
+        size_t cap = ptuc_line_cap ? ptuc_line_cap : PTUC_IBUF_SIZE;
+        while (cap < used + n + 1) { cap *= 2; }
+        char *p = realloc(ptuc_line, cap);
+        if (p == NULL) { return false; }
+        ptuc_line = p;
+        ptuc_line_cap = cap;
+    }
+    memcpy(ptuc_line + used, s, n);
+    ptuc_line[used + n] = '\0';
+    return true;
+}
+
+/*
+  Read the next line (without its newline) from stdin; the result is
+  null-terminated and valid until the next read. Lines that fit in the
+  input buffer are returned in place, longer ones are gathered in a
+  growable buffer that is reused across calls. Returns an empty line
+  at the end of the input.
+*/
+char *
+ptuc_read_line(size_t *len) {
+    size_t spill = 0;
+    for (;;) {
+        char *start = ptuc_ibuf + ptuc_ipos;
+        size_t avail = ptuc_ilen - ptuc_ipos;
+        char *nl = memchr(start, '\n', avail);
+
+        if (nl != NULL || ptuc_ieof) {
+            size_t n = nl != NULL ? (size_t) (nl - start) : avail;
+            ptuc_ipos += nl != NULL ? n + 1 : n;
+            if (spill == 0) {
+                start[n] = '\0';
+                *len = n;
+                return start;
+            }
+            if (!ptuc_line_append(spill, start, n)) { break; }
+            *len = spill + n;
+            return ptuc_line;
+        }
+
+        /* no newline in sight, compact or spill before reading more */
+        if (ptuc_ipos > 0) {
+            memmove(ptuc_ibuf, start, avail);
+            ptuc_ilen = avail;
+            ptuc_ipos = 0;
+        } else if (ptuc_ilen == PTUC_IBUF_SIZE) {
+            if (!ptuc_line_append(spill, ptuc_ibuf, ptuc_ilen)) { break; }
+            spill += ptuc_ilen;
+            ptuc_ilen = 0;
+        }
+
+        /* make prompts visible before blocking on input */
+        if (ptuc_olen > 0) { flushOutput(); }
+        ssize_t n = read(STDIN_FILENO, ptuc_ibuf + ptuc_ilen,
+                         PTUC_IBUF_SIZE - ptuc_ilen);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { ptuc_ieof = true; }
+        else { ptuc_ilen += (size_t) n; }
+    }
+    /* out of memory while growing the line buffer */
+    *len = 0;
+    ptuc_ibuf[ptuc_ilen] = '\0';
+    return ptuc_ibuf + ptuc_ilen;
+}
+
+/* drop whatever is buffered, e.g. after stdin was reopened */
+void
+ptuc_in_reset() {
+    ptuc_ipos = ptuc_ilen = 0;
+    ptuc_ieof = false;
+}
+
+char *
+readString() {
+    size_t len = 0;
+    char *line = ptuc_read_line(&len);
+    if (len > INT_MAX) { len = INT_MAX; }
+    /* a fresh array has its spare element zeroed, so it is terminated */
+    char *s = ptuc_array_resize(NULL, (int) len, 1, NULL);
+    memcpy(s, line, len);
+    return s;
+}
+
+/*
+  this is much more safe and concise that just
+  using atoi, atof that the original implementation
+  used; the numbers are parsed straight out of the
+  input buffer, so no allocation happens per read.
+*/
+int
+readInteger() {
+    size_t len = 0;
+    const char *s = ptuc_read_line(&len);
+    /* same rules as strtol(s, NULL, 10) */
+    while (*s == ' ' || (*s >= '\t' && *s <= '\r')) { s++; }
+    bool neg = *s == '-';
+    if (*s == '-' || *s == '+') { s++; }
+    uint64_t val = 0, lim = neg ? (uint64_t) INT64_MAX + 1 : INT64_MAX;
+    for (; *s >= '0' && *s <= '9'; s++) {
+        uint32_t d = (uint32_t) (*s - '0');
+        if (val > (lim - d) / 10) {
+            /* overflow, saturate as strtol does */
+            errno = ERANGE;
+            val = lim;
+            while (*s >= '0' && *s <= '9') { s++; }
+            break;
+        }
+        val = val * 10 + d;
+    }
+    int64_t sval = neg ? (int64_t) (0 - val) : (int64_t) val;
+    return (int) (uint32_t) sval;
+}
+
+double
+readReal() {
+    size_t len = 0;
+    const char *line = ptuc_read_line(&len), *s = line;
+    /*
+      fast path for plain decimals: when the significand fits in
+      53 bits and the power of ten is exact a single multiply or
+      divide gives the correctly rounded result; anything else is
+      left to strtod.
+    */
+    while (*s == ' ' || (*s >= '\t' && *s <= '\r')) { s++; }
+    bool neg = *s == '-';
+    if (*s == '-' || *s == '+') { s++; }
+    /* hexadecimal floats are left to strtod as well */
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) { return strtod(line, NULL); }
+    uint64_t mant = 0;
+    int32_t ndigits = 0, exp10 = 0;
+    bool any = false;
+    for (; *s >= '0' && *s <= '9'; s++, any = true) {
+        if (mant == 0 && *s == '0') { continue; }
+        if (++ndigits > 19) { return strtod(line, NULL); }
+        mant = mant * 10 + (uint64_t) (*s - '0');
+    }
+    if (*s == '.') {
+        for (s++; *s >= '0' && *s <= '9'; s++, any = true) {
+            exp10--;
+            if (mant == 0 && *s == '0') { continue; }
+            if (++ndigits > 19) { return strtod(line, NULL); }
+            mant = mant * 10 + (uint64_t) (*s - '0');
+        }
+    }
+    if (!any) { return strtod(line, NULL); }
+    if (*s == 'e' || *s == 'E') {
+        const char *e = s + 1;
+        bool eneg = *e == '-';
+        if (*e == '-' || *e == '+') { e++; }
+        if (!(*e >= '0' && *e <= '9')) { return strtod(line, NULL); }
+        int32_t ev = 0;
+        for (; *e >= '0' && *e <= '9'; e++) {
+            if (ev > 1000) { return strtod(line, NULL); }
+            ev = ev * 10 + (*e - '0');
+        }
+        exp10 += eneg ? -ev : ev;
+    }
+    if (mant > ((uint64_t) 1 << 53) || exp10 < -22 || exp10 > 22) {
+        return strtod(line, NULL);
+    }
+    double val = (double) mant;
+    val = exp10 < 0 ? val / ptuc_pow10[-exp10] : val * ptuc_pow10[exp10];
+    return neg ? -val : val;
+}
+
+/* dynamic arrays: power-of-two size classes carved out of large chunks */
+#define PTUC_CHUNK_SIZE ((size_t) 1 << 20)
+/* smallest block: the header plus a few elements */
+#define PTUC_MIN_CLASS 6
+/* blocks of this class and up get a chunk of their own */
+#define PTUC_BIG_CLASS 18
+#define PTUC_CLASSES 64
+
+/* address range covered by the pool, for a quick "not ours" */
+uintptr_t ptuc_pool_lo = 0, ptuc_pool_hi = 0;
+/* the chunk found by the last lookup, checked first */
+uintptr_t ptuc_hot_lo = 0, ptuc_hot_hi = 0;
+
+/* chunk registry structure */
+typedef struct ptuc_chunk {
+    char *lo;   // first byte of the chunk.
+    char *hi;   // one past its last byte.
+} ptuc_chunk_t;
+
+/* every chunk handed to the pool, to tell our arrays from other pointers */
+static ptuc_chunk_t *ptuc_chunks = NULL;
+static size_t ptuc_nchunks = 0, ptuc_chunks_cap = 0;
+
+/* free blocks of each class, linked through their owner field */
+static ptuc_array_hdr_t *ptuc_free[PTUC_CLASSES];
+
+/* unused tail of the chunk small blocks are carved from */
+static char *ptuc_bump = NULL, *ptuc_bump_end = NULL;
+
+static void __attribute__((noreturn))
+ptuc_array_oom() {
+    flushOutput();
+    fprintf(stderr, "\n -- Error: out of memory for arrays\n");
+    exit(EXIT_FAILURE);
+}
+
+/* get a new chunk of `size` bytes from the system */
+static char *
+ptuc_pool_chunk(size_t size) {
+    if (ptuc_nchunks == ptuc_chunks_cap) {
+        size_t cap = ptuc_chunks_cap ? 2 * ptuc_chunks_cap : 16;
+        ptuc_chunk_t *c = realloc(ptuc_chunks, cap * sizeof(*c));
+        if (c == NULL) { ptuc_array_oom(); }
+        ptuc_chunks = c;
+        ptuc_chunks_cap = cap;
+    }
+    char *mem = malloc(size);
+    if (mem == NULL) { ptuc_array_oom(); }
+    ptuc_chunks[ptuc_nchunks].lo = mem;
+    ptuc_chunks[ptuc_nchunks].hi = mem + size;
+    ptuc_nchunks++;
+    if (ptuc_pool_hi == 0 || (uintptr_t) mem < ptuc_pool_lo) { ptuc_pool_lo = (uintptr_t) mem; }
+    if ((uintptr_t) (mem + size) > ptuc_pool_hi) { ptuc_pool_hi = (uintptr_t) (mem + size); }
+    return mem;
+}
+
+/* put a block back on the free list of its class */
+static void
+ptuc_pool_free(ptuc_array_hdr_t *h) {
+    h->magic = 0;
+    h->owner = ptuc_free[h->cls];
+    ptuc_free[h->cls] = h;
+}
+
+/* get a block of size class `cls` */
+static ptuc_array_hdr_t *
+ptuc_pool_alloc(uint32_t cls) {
+    size_t size = (size_t) 1 << cls;
+    ptuc_array_hdr_t *h = ptuc_free[cls];
+    if (h != NULL) {
+        ptuc_free[cls] = h->owner;
+        return h;
+    }
+    if (cls >= PTUC_BIG_CLASS) { return (ptuc_array_hdr_t *) ptuc_pool_chunk(size); }
+    if ((size_t) (ptuc_bump_end - ptuc_bump) < size) {
+        /* hand what is left of the old chunk to the free lists */
+        for (uint32_t c = PTUC_BIG_CLASS - 1; c >= PTUC_MIN_CLASS; c--) {
+            while ((size_t) (ptuc_bump_end - ptuc_bump) >= ((size_t) 1 << c)) {
+                h = (ptuc_array_hdr_t *) ptuc_bump;
+                h->cls = c;
+                ptuc_pool_free(h);
+                ptuc_bump += (size_t) 1 << c;
+            }
+        }
+        ptuc_bump = ptuc_pool_chunk(PTUC_CHUNK_SIZE);
+        ptuc_bump_end = ptuc_bump + PTUC_CHUNK_SIZE;
+    }
+    h = (ptuc_array_hdr_t *) ptuc_bump;
+    ptuc_bump += size;
+    return h;
+}
+
+/* check that `a` is a live array allocated by the runtime */
+bool
+ptuc_array_lookup(const void *a) {
+    const char *h = (const char *) ptuc_array_hdr(a);
+    /* recent chunks are the likely ones */
+    for (size_t i = ptuc_nchunks; i-- > 0;) {
+        if (h >= ptuc_chunks[i].lo && h < ptuc_chunks[i].hi) {
+            ptuc_hot_lo = (uintptr_t) ptuc_chunks[i].lo;
+            ptuc_hot_hi = (uintptr_t) ptuc_chunks[i].hi;
+            return ((const ptuc_array_hdr_t *) h)->magic == PTUC_ARRAY_MAGIC;
+        }
+    }
+    return false;
+}
+
+/* the length of `a`, which may be a C string but no other foreign memory */
+static int
+ptuc_array_len(const void *a, size_t size) {
+    if (a == NULL) { return 0; }
+    if (ptuc_array_is(a)) { return ptuc_array_hdr(a)->len; }
+    if (size != 1) {
+        flushOutput();
+        fprintf(stderr, "\n -- Error: resizing memory that is not a dynamic array\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t len = strlen(a);
+    return len > INT_MAX - 1 ? INT_MAX - 1 : (int) len;
+}
+
+/* `var` no longer holds the array of `h`, hand it to its alias or release it */
+static void
+ptuc_array_drop(ptuc_array_hdr_t *h, void *var) {
+    if (h->owner == var) {
+        if (h->alias != NULL && *(void **) h->alias == (void *) (h + 1)) {
+            h->owner = h->alias;
+            h->alias = NULL;
+        } else {
+            ptuc_pool_free(h);
+        }
+    } else if (h->alias == var) {
+        h->alias = NULL;
+    }
+}
+
+/* resize `a` (elements of `size` bytes) to `n` elements on behalf of `owner` */
+void *
+ptuc_array_resize(void *a, int n, size_t size, void *owner) {
+    ptuc_array_hdr_t *h = ptuc_array_is(a) ? ptuc_array_hdr(a) : NULL;
+    /* a C string is copied into the new array */
+    int len = ptuc_array_len(a, size);
+    if (n < 0) { n = 0; }
+
+    if (h != NULL && n <= h->cap) {
+        /* keep everything past the end zeroed */
+        if (n < len) { memset((char *) a + (size_t) n * size, 0, (size_t) (len - n) * size); }
+        h->len = n;
+        if (h->owner == NULL) { h->owner = owner; }
+        return a;
+    }
+
+    /* room for the header, `n` elements and the spare one */
+    if ((size_t) n + 1 > (SIZE_MAX / 2 - sizeof(*h)) / size) { ptuc_array_oom(); }
+    size_t need = sizeof(*h) + ((size_t) n + 1) * size;
+    uint32_t cls = PTUC_MIN_CLASS;
+    while (((size_t) 1 << cls) < need) { cls++; }
+
+    ptuc_array_hdr_t *nh = ptuc_pool_alloc(cls);
+    size_t cap = (((size_t) 1 << cls) - sizeof(*nh)) / size - 1;
+    nh->owner = owner;
+    nh->alias = NULL;
+    nh->len = n;
+    nh->cap = cap > INT_MAX ? INT_MAX : (int) cap;
+    nh->magic = PTUC_ARRAY_MAGIC;
+    nh->cls = cls;
+
+    char *data = (char *) (nh + 1);
+    size_t keep = (size_t) (len < n ? len : n) * size;
+    if (keep > 0) { memcpy(data, a, keep); }
+    memset(data + keep, 0, ((size_t) nh->cap + 1) * size - keep);
+    if (h != NULL) {
+        /* nobody else holds an array without an owner */
+        if (h->owner == NULL) { ptuc_pool_free(h); }
+        else { ptuc_array_drop(h, owner); }
+    }
+    return data;
+}
+
+/* grow `a` by one element the slow way (see ptuc_array_push) */
+void *
+ptuc_array_grow(void *a, size_t size, void *owner)
+    {return ptuc_array_resize(a, ptuc_array_len(a, size) + 1, size, owner);}
+
+/* release `a` if `owner` may do so, returns NULL */
+void *
+ptuc_array_release(void *a, void *owner) {
+    if (ptuc_array_is(a)) {
+        ptuc_array_hdr_t *h = ptuc_array_hdr(a);
+        if (h->owner == NULL) { ptuc_pool_free(h); }
+        else { ptuc_array_drop(h, owner); }
+    }
+    return NULL;
+}
+
+/* `var` now holds an array instead of `old`, update their owners */
+void
+ptuc_array_assign(void *var, void *old) {
+    void *a = *(void **) var;
+    if (a == old) { return; }
+    if (ptuc_array_is(old)) { ptuc_array_drop(ptuc_array_hdr(old), var); }
+    if (ptuc_array_is(a)) {
+        ptuc_array_hdr_t *h = ptuc_array_hdr(a);
+        if (h->owner == NULL) { h->owner = var; }
+        else if (h->owner != var) { h->alias = var; }
+    }
+}
+
+/* scope-exit hook for array variables, `var` points to the variable */
+void
+ptuc_array_cleanup(void *var) {
+    void *a = *(void **) var;
+    if (ptuc_array_is(a)) { ptuc_array_drop(ptuc_array_hdr(a), var); }
+}
+
+/* scope-exit hook for array results, the caller gets them unowned */
+void
+ptuc_array_disown(void *var) {
+    void *a = *(void **) var;
+    if (ptuc_array_is(a)) {
+        ptuc_array_hdr_t *h = ptuc_array_hdr(a);
+        if (h->owner == var) {
+            /* an alias outliving the function keeps it */
+            if (h->alias != NULL && *(void **) h->alias == a) { h->owner = h->alias; }
+            else { h->owner = NULL; }
+            h->alias = NULL;
+        } else if (h->alias == var) {
+            h->alias = NULL;
+        }
+    }
+}
+
+/* report an out of range index at ptuc line `line` and exit */
+void
+ptuc_array_range_error(const void *a, int i, int line) {
+    flushOutput();
+    fprintf(stderr, "\n -- Error: line %d: index %d out of range for array of length %d\n",
+            line, i, arrayLength(a));
+    exit(EXIT_FAILURE);
+}
@@ -6,43 +6,287 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <errno.h>
+#include <math.h>
+#include <unistd.h>
 
-#define writeString(x) printf("%s",(x))
-#define writeInteger(x) printf("%d",(x))
-#define writeFloat(x) printf("%f", (x))
-#define writeReal(x) printf("%g",(x))
+/*
+  The runtime keeps its own user-space buffers for stdin/stdout
+  and talks to file descriptors 0 and 1 directly; this avoids both
+  the format-string parsing of printf and the per-call locking of
+  stdio.
+
+  Output is flushed when the buffer fills up, before every read
+  (so prompts are visible), at program exit and when flushOutput()
+  is called explicitly. When stdout is a terminal every write is
+  flushed immediately. Mixing these calls with raw stdio output
+  requires a flushOutput() in between to preserve ordering.
+
+  Only the hot write helpers are defined here (static inline); the
+  rest of the runtime lives in ptuclib.c and is linked in from
+  libptuc.a or libptuc.so.
+*/
+
+#define PTUC_OBUF_SIZE (1 << 16)
+#define PTUC_IBUF_SIZE (1 << 16)
+
+/* largest text a single formatted number can produce ("%f" of DBL_MAX) */
+#define PTUC_NUM_MAX 512
+
+/* output buffer state */
+extern char ptuc_obuf[PTUC_OBUF_SIZE];
+extern size_t ptuc_olen;
+/* 0: not initialised yet, 1: buffered, 2: flush on every write (tty) */
+extern int ptuc_omode;
+
+/* input buffer state (one spare byte to null-terminate in place) */
+extern char ptuc_ibuf[PTUC_IBUF_SIZE + 1];
+extern size_t ptuc_ipos, ptuc_ilen;
+extern bool ptuc_ieof;
+
+/* two-digit lookup table used by the integer formatter */
+extern const char ptuc_digits[201];
+
+/* write the output buffer out to stdout */
+void flushOutput();
+
+/* lazily pick the output mode and make sure we flush at exit */
+void ptuc_out_init();
+
+/* write `len` bytes straight to stdout, bypassing the buffer */
+void ptuc_write_direct(const char *s, size_t len);
+
+/* same output as printf("%g") */
+void writeReal(double x);
+
+/* same output as printf("%f") */
+void writeFloat(double x);
 
-#define BUFSIZE 1024
+/*
+  Read the next line (without its newline) from stdin; the result is
+  null-terminated and valid until the next read.
+*/
+char *ptuc_read_line(size_t *len);
+
+/* drop whatever is buffered, e.g. after stdin was reopened */
+void ptuc_in_reset();
+
+/* read a line into a new array of char (see dynamic arrays below) */
+char *readString();
+
+/* read a line and parse it as an integer */
+int readInteger();
+
+/* read a line and parse it as a real */
+double readReal();
+
+/* make room for at least `n` bytes in the output buffer */
+static inline void
+ptuc_out_reserve(size_t n) {
+    if (ptuc_omode == 0) { ptuc_out_init(); }
+    if (PTUC_OBUF_SIZE - ptuc_olen < n) { flushOutput(); }
+}
+
+/* called at the end of every write call */
+static inline void
+ptuc_out_done() {
+    if (ptuc_omode == 2) { flushOutput(); }
+}
 
-char *readString() {
-    char buffer[BUFSIZE];
-    buffer[0] = '\0';
-    fgets(buffer, BUFSIZE, stdin);
-    /* strip newline from the end */
-    uint32_t blen = strlen(buffer);
-    if (blen > 0 && buffer[blen - 1] == '\n')
-        buffer[blen - 1] = '\0';
-    return strdup(buffer);
+/* format `v` into the tail of `end`, returning the first character */
+static inline char *
+ptuc_fmt_u64(char *end, uint64_t v) {
+    while (v >= 100) {
+        uint32_t r = (uint32_t) (v % 100);
+        v /= 100;
+        end -= 2;
+        memcpy(end, ptuc_digits + 2 * r, 2);
+    }
+    if (v >= 10) {
+        end -= 2;
+        memcpy(end, ptuc_digits + 2 * v, 2);
+    } else {
+        *--end = (char) ('0' + v);
+    }
+    return end;
 }
 
-#undef BUFSIZE
+/* append a signed integer to the output buffer */
+static inline void
+ptuc_put_i64(int64_t v) {
+    char tmp[24], *end = tmp + sizeof(tmp), *p;
+    uint64_t u = v < 0 ? 0 - (uint64_t) v : (uint64_t) v;
+    p = ptuc_fmt_u64(end, u);
+    if (v < 0) { *--p = '-'; }
+    memcpy(ptuc_obuf + ptuc_olen, p, (size_t) (end - p));
+    ptuc_olen += (size_t) (end - p);
+}
+
+static inline void
+writeString(const char *s) {
+    size_t len = strlen(s);
+    ptuc_out_reserve(len);
+    if (len > PTUC_OBUF_SIZE) {
+        /* too large to buffer, hand it straight to the kernel */
+        ptuc_write_direct(s, len);
+        return;
+    }
+    memcpy(ptuc_obuf + ptuc_olen, s, len);
+    ptuc_olen += len;
+    ptuc_out_done();
+}
+
+static inline void
+writeInteger(int x) {
+    ptuc_out_reserve(24);
+    ptuc_put_i64(x);
+    ptuc_out_done();
+}
 
 /*
-  this is much more safe and concise that just 
-  using atoi, atof that the original implementation
-  used 
+  Dynamic arrays (`array of T`) are plain `T *` pointers to the first
+  element, preceded in memory by a header with the length, capacity
+  and owner of the array; indexing and C string functions work on
+  them unchanged and NULL is the empty array. Storage comes out of a
+  per-program pool of power-of-two size classes, so growth is
+  amortised and releasing an array just puts its block back on the
+  free list of its class.
+
+  An array belongs to the variable it was first assigned to or resized
+  through and is released when that variable goes out of scope (see
+  PTUC_ARRAY), is assigned another array or grows out of its block;
+  arrays without an owner (returned by readString or by a function)
+  are adopted this way as well. The last other variable an array was
+  assigned to is remembered as its alias: when the owner lets go of
+  the array while the alias still holds it, the alias becomes the
+  owner instead of the array being released, which is how `result`
+  takes over a local array and how aliases survive their owner
+  growing. One spare zeroed element is always kept past the end, so
+  arrays of char stay null-terminated; resizing a plain C string (e.g.
+  a literal) copies it into a new array.
+
+  Indexing is bounds-checked unless NDEBUG is defined.
 */
-int readInteger() {
-    char *s = readString();
-    uint32_t val = (uint32_t) strtol(s, NULL, 10);
-    free(s);
-    return val;
+
+typedef struct ptuc_array_hdr {
+    _Alignas(16) void *owner;   // address of the owning variable.
+    void *alias;                // address of the last other variable assigned it.
+    int len;                    // elements in use.
+    int cap;                    // elements available (without the spare one).
+    uint32_t magic;             // PTUC_ARRAY_MAGIC while the array is live.
+    uint32_t cls;               // size class of the block.
+} ptuc_array_hdr_t;
+
+#define PTUC_ARRAY_MAGIC 0x70747563u
+
+/* the header of array `a` */
+#define ptuc_array_hdr(a) ((ptuc_array_hdr_t *) (a) - 1)
+
+/* address range covered by the pool, for a quick "not ours" */
+extern uintptr_t ptuc_pool_lo, ptuc_pool_hi;
+/* the chunk found by the last lookup, checked first */
+extern uintptr_t ptuc_hot_lo, ptuc_hot_hi;
+
+/* check that `a` is a live array allocated by the runtime */
+bool ptuc_array_lookup(const void *a);
+
+static inline bool
+ptuc_array_is(const void *a) {
+    uintptr_t p = (uintptr_t) a, h = p - sizeof(ptuc_array_hdr_t);
+    if (h - ptuc_hot_lo < ptuc_hot_hi - ptuc_hot_lo) {
+        return ptuc_array_hdr(a)->magic == PTUC_ARRAY_MAGIC;
+    }
+    return p - ptuc_pool_lo < ptuc_pool_hi - ptuc_pool_lo && ptuc_array_lookup(a);
 }
 
-double readReal() {
-    char *s = readString();
-    double val = strtod(s, NULL);
-    free(s);
-    return val;
+/* resize `a` (elements of `size` bytes) to `n` elements on behalf of `owner` */
+void *ptuc_array_resize(void *a, int n, size_t size, void *owner);
+
+
+/* grow `a` by one element the slow way (see ptuc_array_push) */
+void *ptuc_array_grow(void *a, size_t size, void *owner);
+
+/* release `a` if `owner` may do so, returns NULL */
+void *ptuc_array_release(void *a, void *owner);
+
+/* `var` now holds an array instead of `old`, update their owners */
+void ptuc_array_assign(void *var, void *old);
+
+/* scope-exit hook for array variables, `var` points to the variable */
+void ptuc_array_cleanup(void *var);
+
+/* scope-exit hook for array results, the caller gets them unowned */
+void ptuc_array_disown(void *var);
+
+/* report an out of range index at ptuc line `line` and exit */
+void ptuc_array_range_error(const void *a, int i, int line) __attribute__((noreturn));
+
+/* attached by ptucc to every `array of` variable */
+#define PTUC_ARRAY __attribute__((cleanup(ptuc_array_cleanup)))
+
+/* attached by ptucc to the result of functions returning arrays */
+#define PTUC_RESULT __attribute__((cleanup(ptuc_array_disown)))
+
+/* __builtin_classify_type() of pointers, the only values that can be arrays */
+#define PTUC_POINTER_CLASS 5
+
+/* `a := x`, keeping track of the owner when `a` holds an array */
+#define PTUC_ASSIGN(a, x) do { \
+    __typeof__(a) *ptuc_var = &(a); \
+    void *ptuc_old = __builtin_classify_type(a) == PTUC_POINTER_CLASS ? \
+                     *(void **) ptuc_var : NULL; \
+    *ptuc_var = (x); \
+    if (__builtin_classify_type(a) == PTUC_POINTER_CLASS) { \
+        ptuc_array_assign(ptuc_var, ptuc_old); \
+    } \
+} while (0)
+
+/* only pointers can be dynamic arrays, fixed arrays are never checked */
+#ifdef NDEBUG
+#define PTUC_INDEX(a, i, line) (i)
+#else
+#define PTUC_INDEX(a, i, line) \
+    (__builtin_types_compatible_p(__typeof__(a), __typeof__(&(a)[0])) ? \
+     ptuc_array_check((a), (i), (line)) : (i))
+#endif
+
+/* bounds check for the first index of `a`, other pointers pass through */
+static inline int
+ptuc_array_check(const void *a, int i, int line) {
+    if (ptuc_array_is(a) && (i < 0 || i >= ptuc_array_hdr(a)->len)) {
+        ptuc_array_range_error(a, i, line);
+    }
+    return i;
+}
+
+/* make room for one more element at the end of `a` */
+static inline void *
+ptuc_array_push(void *a, size_t size, void *owner) {
+    if (ptuc_array_is(a)) {
+        ptuc_array_hdr_t *h = ptuc_array_hdr(a);
+        if (h->len < h->cap) {
+            /* the spare element past the end is zeroed already */
+            if (h->owner == NULL) { h->owner = owner; }
+            h->len++;
+            return a;
+        }
+    }
+    return ptuc_array_grow(a, size, owner);
 }
 
+/* number of elements in `a` */
+static inline int
+arrayLength(const void *a)
+    {return ptuc_array_is(a) ? ptuc_array_hdr(a)->len : 0;}
+
+/* resize `a` to `n` elements, new elements are zeroed */
+#define arrayResize(a, n) \
+    ((a) = ptuc_array_resize((a), (n), sizeof(*(a)), &(a)))
+
+/* append `x` to `a` */
+#define arrayAppend(a, x) \
+    ((a) = ptuc_array_push((a), sizeof(*(a)), &(a)), \
+     (a)[ptuc_array_hdr(a)->len - 1] = (x))
+
+/* release `a` now instead of at the end of its scope */
+#define arrayRelease(a) \
+    ((a) = ptuc_array_release((a), &(a)))
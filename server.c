@@ -0,0 +1,387 @@
+/**
+ * Persistent compile server and its client.
+ *
+ * `ptucc --server path` listens on a Unix domain socket; for every
+ * request it forks a child which inherits the warm state of the
+ * server (including the module cache), so requests are served
+ * concurrently and never see each other's lexer/parser globals.
+ *
+ * `ptucc --client path args...` forwards its arguments, working
+ * directory and standard streams to the server and exits with the
+ * status of the compile, so it can be used as a drop-in for `ptucc`.
+ *
+ * Wire format (client -> server): a header of two uint32_t values
+ * (magic, argc) carrying the client's stdin/stdout/stderr as
+ * SCM_RIGHTS ancillary data, then the working directory and each
+ * argument as a uint32_t length followed by the bytes. The server
+ * answers with the int32_t exit status of the compile.
+ *
+ * Requests act with the rights of the server (they pick the working
+ * directory and the output files), so the socket is only accessible
+ * to its owner and peers running as another user are turned away.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "modcache.h"
+#include "server.h"
+
+#define SRV_MAGIC 0x70747563u   // "ptuc"
+#define SRV_MAX_ARGS 1024       // arguments per request
+#define SRV_MAX_STR (1 << 16)   // bytes per argument
+#define SRV_MAX_REQS 256        // requests served at the same time
+
+/* a request being served by a child */
+typedef struct srv_req {
+    pid_t pid;          // child serving the request.
+    int report_fd;      // modules the child missed in the cache.
+    char *buf;          // reported paths received so far.
+    size_t len;         // bytes in buf.
+} srv_req_t;
+
+/* set by the signal handler to stop the server */
+static volatile sig_atomic_t srv_stop = 0;
+
+static void
+srv_on_signal(int sig)
+    {(void) sig; srv_stop = 1;}
+
+/* write all of `len` bytes */
+static bool
+write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }
+        p += n;
+        len -= (size_t) n;
+    }
+    return true;
+}
+
+/* read exactly `len` bytes */
+static bool
+read_all(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) { continue; }
+        if (n <= 0) { return false; }
+        p += n;
+        len -= (size_t) n;
+    }
+    return true;
+}
+
+/* send a length-prefixed string */
+static bool
+send_str(int fd, const char *s) {
+    uint32_t len = (uint32_t) strlen(s);
+    return len <= SRV_MAX_STR &&
+           write_all(fd, &len, sizeof(len)) && write_all(fd, s, len);
+}
+
+/* receive a length-prefixed string, to be freed by the caller */
+static char *
+recv_str(int fd) {
+    uint32_t len;
+    if (!read_all(fd, &len, sizeof(len)) || len > SRV_MAX_STR) { return NULL; }
+    char *s = malloc(len + 1);
+    if (s == NULL || !read_all(fd, s, len)) {
+        free(s);
+        return NULL;
+    }
+    s[len] = '\0';
+    return s;
+}
+
+/* fill in the address of the socket at `path` */
+static bool
+srv_addr(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "\n -- Error: socket path %s is too long\n", path);
+        return false;
+    }
+    strcpy(addr->sun_path, path);
+    return true;
+}
+
+/**
+ * Forward `argc`/`argv` (argv[0] included) to the server on `sock_path`.
+ */
+int
+run_client(const char *sock_path, int argc, char **argv) {
+    struct sockaddr_un addr;
+    char cwd[PATH_MAX];
+    int32_t status = EXIT_FAILURE;
+
+    if (!srv_addr(sock_path, &addr)) { return EXIT_FAILURE; }
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        perror(" -- Error: getcwd");
+        return EXIT_FAILURE;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "\n -- Error: could not connect to ptucc server at %s\n",
+                sock_path);
+        if (fd >= 0) { close(fd); }
+        return EXIT_FAILURE;
+    }
+
+    /* a server that turns us away is reported below, not by SIGPIPE */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* the header carries our standard streams */
+    uint32_t hdr[2] = {SRV_MAGIC, (uint32_t) argc};
+    int fds[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    union {
+        struct cmsghdr h;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } ctl;
+    struct iovec iov = {hdr, sizeof(hdr)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(c), fds, sizeof(fds));
+
+    bool sent = sendmsg(fd, &msg, 0) == (ssize_t) sizeof(hdr) &&
+                send_str(fd, cwd);
+    for (int i = 0; sent && i < argc; i++) { sent = send_str(fd, argv[i]); }
+
+    if (!sent || !read_all(fd, &status, sizeof(status))) {
+        fprintf(stderr, "\n -- Error: ptucc server did not complete the request\n");
+        status = EXIT_FAILURE;
+    }
+    close(fd);
+    return status;
+}
+
+/* only serve clients running as our own user */
+static bool
+srv_peer_ok(int conn) {
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 ||
+        len != sizeof(cred)) { return false; }
+    return cred.uid == getuid();
+}
+
+/* serve one request inside a forked child, never returns */
+static void
+srv_serve(int conn) {
+    uint32_t hdr[2];
+    int fds[3] = {-1, -1, -1};
+    union {
+        struct cmsghdr h;
+        char buf[CMSG_SPACE(sizeof(fds))];
+    } ctl;
+    struct iovec iov = {hdr, sizeof(hdr)};
+    struct msghdr msg = {0};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctl.buf;
+    msg.msg_controllen = sizeof(ctl.buf);
+
+    ssize_t n = recvmsg(conn, &msg, MSG_CMSG_CLOEXEC);
+    struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    if (n < (ssize_t) sizeof(hdr) || c == NULL ||
+        c->cmsg_type != SCM_RIGHTS || c->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        _exit(EXIT_FAILURE);
+    }
+    memcpy(fds, CMSG_DATA(c), sizeof(fds));
+    if (hdr[0] != SRV_MAGIC || hdr[1] == 0 || hdr[1] > SRV_MAX_ARGS) {
+        _exit(EXIT_FAILURE);
+    }
+
+    int argc = (int) hdr[1];
+    char *cwd = recv_str(conn), **argv = calloc((size_t) argc + 1, sizeof(*argv));
+    if (cwd == NULL || argv == NULL) { _exit(EXIT_FAILURE); }
+    for (int i = 0; i < argc; i++) {
+        if ((argv[i] = recv_str(conn)) == NULL) { _exit(EXIT_FAILURE); }
+    }
+
+    /* become the client: its streams and its working directory */
+    for (int i = 0; i < 3; i++) {
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+    int32_t status = EXIT_FAILURE;
+    if (chdir(cwd) != 0) {
+        fprintf(stderr, "\n -- Error: could not change directory to %s\n", cwd);
+    } else {
+        status = compile_main(argc, argv);
+    }
+    fflush(stdout);
+    fflush(stderr);
+    write_all(conn, &status, sizeof(status));
+    _exit(status);
+}
+
+/* collect what the child reported, false once it is done */
+static bool
+srv_read_report(srv_req_t *r) {
+    char buf[4096];
+    ssize_t n = read(r->report_fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR) { return true; }
+    if (n <= 0) { return false; }
+    char *p = realloc(r->buf, r->len + (size_t) n + 1);
+    if (p == NULL) { return false; }
+    memcpy(p + r->len, buf, (size_t) n);
+    r->buf = p;
+    r->len += (size_t) n;
+    r->buf[r->len] = '\0';
+    return true;
+}
+
+/* warm the cache with the modules the child missed */
+static void
+srv_finish(srv_req_t *r) {
+    for (char *line = r->buf, *nl; line && (nl = strchr(line, '\n')); line = nl + 1) {
+        *nl = '\0';
+        if (!modcache_load(line)) {
+            fprintf(stderr, "\n -- Warning: could not cache module %s\n", line);
+        }
+    }
+    close(r->report_fd);
+    free(r->buf);
+}
+
+/**
+ * Run the compile server on `sock_path` until SIGINT/SIGTERM.
+ */
+int
+run_server(const char *sock_path) {
+    struct sockaddr_un addr;
+    if (!srv_addr(sock_path, &addr)) { return EXIT_FAILURE; }
+
+    /* refuse to steal the socket of a live server */
+    int lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (lfd >= 0 && connect(lfd, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+        fprintf(stderr, "\n -- Error: a ptucc server is already running on %s\n",
+                sock_path);
+        close(lfd);
+        return EXIT_FAILURE;
+    }
+    if (lfd >= 0) { close(lfd); }
+
+    /* only a stale socket may be replaced, never any other file */
+    struct stat st;
+    if (lstat(sock_path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "\n -- Error: %s exists and is not a socket\n", sock_path);
+            return EXIT_FAILURE;
+        }
+        unlink(sock_path);
+    }
+    lfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    /* the socket is created 0600, there is no window to connect before a chmod */
+    mode_t old_mask = umask(0077);
+    bool bound = lfd >= 0 && bind(lfd, (struct sockaddr *) &addr, sizeof(addr)) == 0;
+    umask(old_mask);
+    if (!bound || listen(lfd, SOMAXCONN) != 0) {
+        fprintf(stderr, "\n -- Error: could not listen on %s: %s\n",
+                sock_path, strerror(errno));
+        if (lfd >= 0) { close(lfd); }
+        return EXIT_FAILURE;
+    }
+
+    struct sigaction sa = {0};
+    sa.sa_handler = srv_on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    fprintf(stderr, "\n ** ptucc server listening on %s\n", sock_path);
+
+    srv_req_t reqs[SRV_MAX_REQS];
+    struct pollfd pfd[SRV_MAX_REQS + 1];
+    int nreqs = 0;
+
+    while (!srv_stop) {
+        pfd[0].fd = lfd;
+        pfd[0].events = POLLIN;
+        for (int i = 0; i < nreqs; i++) {
+            pfd[i + 1].fd = reqs[i].report_fd;
+            pfd[i + 1].events = POLLIN;
+        }
+        if (poll(pfd, (nfds_t) nreqs + 1, -1) < 0) {
+            if (errno == EINTR) { continue; }
+            perror(" -- Error: poll");
+            break;
+        }
+
+        /* a closed report pipe means that request is done */
+        for (int i = nreqs - 1; i >= 0; i--) {
+            if (pfd[i + 1].revents && !srv_read_report(&reqs[i])) {
+                srv_finish(&reqs[i]);
+                reqs[i] = reqs[--nreqs];
+            }
+        }
+        while (waitpid(-1, NULL, WNOHANG) > 0) {}
+
+        if (!(pfd[0].revents & POLLIN)) { continue; }
+        int conn = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) { continue; }
+        if (!srv_peer_ok(conn)) {
+            close(conn);
+            continue;
+        }
+        /* too busy, the client reports the dropped request */
+        int rp[2];
+        if (nreqs == SRV_MAX_REQS || pipe2(rp, O_CLOEXEC) != 0) {
+            close(conn);
+            continue;
+        }
+
+        fflush(NULL);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(lfd);
+            close(rp[0]);
+            for (int i = 0; i < nreqs; i++) { close(reqs[i].report_fd); }
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            signal(SIGPIPE, SIG_DFL);
+            modcache_report_to(rp[1]);
+            srv_serve(conn);
+        }
+        close(conn);
+        close(rp[1]);
+        if (pid < 0) {
+            close(rp[0]);
+            continue;
+        }
+        reqs[nreqs++] = (srv_req_t) {pid, rp[0], NULL, 0};
+    }
+
+    fprintf(stderr, "\n ** ptucc server on %s shutting down\n", sock_path);
+    for (int i = 0; i < nreqs; i++) {
+        close(reqs[i].report_fd);
+        free(reqs[i].buf);
+    }
+    close(lfd);
+    unlink(sock_path);
+    modcache_destroy();
+    return EXIT_SUCCESS;
+}
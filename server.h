@@ -0,0 +1,30 @@
+/**
+ * Persistent compile server and its client.
+ *
+ * `ptucc --server path` listens on a Unix domain socket; for every
+ * request it forks a child which inherits the warm state of the
+ * server (including the module cache), so requests are served
+ * concurrently and never see each other's lexer/parser globals.
+ *
+ * `ptucc --client path args...` forwards its arguments, working
+ * directory and standard streams to the server and exits with the
+ * status of the compile, so it can be used as a drop-in for `ptucc`.
+ */
+
+#pragma once
+
+/**
+ * Run the compile server on `sock_path` until SIGINT/SIGTERM.
+ */
+int run_server(const char *sock_path);
+
+/**
+ * Forward `argc`/`argv` (argv[0] included) to the server on `sock_path`.
+ */
+int run_client(const char *sock_path, int argc, char **argv);
+
+/**
+ * A single compile with the given arguments, returns the exit status
+ * (implemented in ptucc.c).
+ */
+int compile_main(int argc, char **argv);